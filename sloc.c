@@ -5,6 +5,9 @@
  *      add new languages.
  */
 
+/* for SCHED_IDLE */
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,19 +15,103 @@
 #include <unistd.h>
 #include <dirent.h>
 #include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <sched.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 #include "sloc.h"
 #include "languages.h"
 
 #define NUM_LANGS sizeof(langs) / sizeof(lang_t)
 
+/* options that apply to the whole run, set while parsing the arguments */
+static int              shard_idx = 0;      /* shard of the tree to count */
+static int              shard_cnt = 1;      /* total number of shards */
+static int              partial_files = 0;  /* keep per-file partial records */
+static char *           shard_root = NULL;  /* operand being counted */
+
+/* files found while estimating, sampled after the walk is finished */
+static int              estimate = 0;
+static est_file_t *     est_files = NULL;
+static int              num_est_files = 0;
+static int              max_est_files = 0;
+
+/* resource budget, and how much of it has been used */
+static int              budget = 0;         /* nonzero if anything is limited */
+static double           cpu_frac = 0;       /* fraction of a cpu, or 0 */
+static bucket_t         io_bucket = {0, 0, 0, 0};
+static bucket_t         file_bucket = {0, 0, 0, 0};
+static double           budget_start = 0;
+static double           bytes_read = 0;
+static long             files_opened = 0;
+
+/* set by the signal handlers, and handled by poll_signals */
+static volatile sig_atomic_t    sig_pending = 0;
+static volatile sig_atomic_t    sig_tick = 0;
+static volatile sig_atomic_t    sig_stop = 0;
+static volatile sig_atomic_t    sig_snapshot = 0;
+
+/* progress and early stopping */
+static int              progress = 0;
+static double           deadline = 0;       /* time to stop, or 0 */
+static char *           stopped = NULL;     /* why counting stopped early */
+static sloc_t *         run_counts = NULL; /* for snapshots and checkpoints */
+static sloc_t *         run_added = NULL;   /* for snapshots of a diff */
+static sloc_t *         run_removed = NULL;
+static int *            run_changed = NULL;
+static int              run_tots = 1;
+static double           start_time = 0;
+static long             done_files = 0;
+static double           done_bytes = 0;
+static long             total_files = -1;   /* -1 if not known */
+static char *           cur_dir = NULL;
+
+/* checkpoints, and where to resume a checkpointed walk */
+static char *           ckpt_file = NULL;
+static double           ckpt_interval = CKPT_INTERVAL;
+static double           ckpt_next = 0;      /* time the next one is due */
+static int              ckpt_due = 0;
+static unsigned long    ckpt_hash = 0;      /* fingerprint of the arguments */
+static int              ckpt_op = 0;        /* index of the current operand */
+static char             last_done[BUFSIZ];  /* last file counted */
+static char *           resume_path = NULL; /* skip the walk up to here */
+
+/* per-file records to be written to a partial file */
+static sloc_file_t *    file_recs = NULL;
+static int              num_file_recs = 0;
+static int              max_file_recs = 0;
+
 int main(int argc, char **argv)
 {
     int     i;
-    int     numcounts = 0;
-    char *  pwd;
+    int     j;
+    int *   ops;
+    int     numops = 0;
+    char *  pwd = NULL;
     sloc_t  counts[NUM_LANGS];
     int     print_tots = 1;
+    int     merge = 0;
+    char *  partial_out = NULL;
+    double  est_err = -1;
+    double  est_time = 0;
+    double  hw[NUM_LANGS][NUM_MEMBERS];
+    int     sampled[NUM_LANGS];
+    char *  diff_old = NULL;
+    char *  diff_new = NULL;
+    sloc_t  added[NUM_LANGS];
+    sloc_t  removed[NUM_LANGS];
+    int     changed[NUM_LANGS];
+    int     idle = 0;
+    double  limit = 0;
+    char *  resume_file = NULL;
+    long    found;
 
     /* initilize all the count values to 0 */
     for (i = 0; i < NUM_LANGS; i++)
@@ -36,6 +123,14 @@ int main(int argc, char **argv)
         counts[i].files = 0;
     }
 
+    /* indices of the arguments to count, processed after all the options */
+    ops = (int *)malloc(argc * sizeof(int));
+    if (ops == NULL)
+    {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
     for (i = 1; i < argc; i++)
     {
         if (strcmp(argv[i], "-v") == 0)
@@ -53,47 +148,395 @@ int main(int argc, char **argv)
             /* don't print totals */
             print_tots = 0;
         }
+        else if (strcmp(argv[i], "--emit-partial") == 0)
+        {
+            if (++i == argc)
+            {
+                disp_usage(argv[0]);
+            }
+            /* write the raw counts instead of (or as well as) the table */
+            partial_out = argv[i];
+        }
+        else if (strcmp(argv[i], "--partial-files") == 0)
+        {
+            /* include per-file records in the partial file */
+            partial_files = 1;
+        }
+        else if (strcmp(argv[i], "--merge") == 0)
+        {
+            /* the arguments are partial files, not source files */
+            merge = 1;
+        }
+        else if (strcmp(argv[i], "--io-rate") == 0)
+        {
+            if (++i == argc)
+            {
+                disp_usage(argv[0]);
+            }
+            /* bytes read per second */
+            io_bucket.rate = parse_rate(argv[i]);
+            budget = 1;
+        }
+        else if (strcmp(argv[i], "--file-rate") == 0)
+        {
+            if (++i == argc)
+            {
+                disp_usage(argv[0]);
+            }
+            /* files opened per second; a rate of 0 would mean no limit */
+            file_bucket.rate = parse_num(argv[i]);
+            if (file_bucket.rate <= 0)
+            {
+                fprintf(stderr, "error: '%s' is not a valid rate!\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+            budget = 1;
+        }
+        else if (strcmp(argv[i], "--cpu") == 0)
+        {
+            if (++i == argc)
+            {
+                disp_usage(argv[0]);
+            }
+            /* percentage of one cpu */
+            cpu_frac = parse_num(argv[i]) / 100;
+            if (cpu_frac <= 0 || cpu_frac > 1)
+            {
+                fprintf(stderr, "error: --cpu must be between 0 and 100!\n");
+                exit(EXIT_FAILURE);
+            }
+            budget = 1;
+        }
+        else if (strcmp(argv[i], "--idle") == 0)
+        {
+            /* only use the cpu and disk when nothing else wants them */
+            idle = 1;
+        }
+        else if (strcmp(argv[i], "--progress") == 0)
+        {
+            /* report progress on stderr */
+            progress = 1;
+        }
+        else if (strcmp(argv[i], "--deadline") == 0)
+        {
+            if (++i == argc)
+            {
+                disp_usage(argv[0]);
+            }
+            /* stop counting after this many seconds */
+            limit = parse_num(argv[i]);
+        }
+        else if (strcmp(argv[i], "--checkpoint") == 0)
+        {
+            if (++i == argc)
+            {
+                disp_usage(argv[0]);
+            }
+            /* save the progress of the walk now and then */
+            ckpt_file = argv[i];
+        }
+        else if (strcmp(argv[i], "--checkpoint-interval") == 0)
+        {
+            if (++i == argc)
+            {
+                disp_usage(argv[0]);
+            }
+            ckpt_interval = parse_num(argv[i]);
+        }
+        else if (strcmp(argv[i], "--resume") == 0)
+        {
+            if (++i == argc)
+            {
+                disp_usage(argv[0]);
+            }
+            /* continue the walk saved in a checkpoint */
+            resume_file = argv[i];
+        }
+        else if (strcmp(argv[i], "--diff") == 0)
+        {
+            if (i + 2 >= argc)
+            {
+                disp_usage(argv[0]);
+            }
+            /* compare two trees instead of counting them */
+            diff_old = argv[++i];
+            diff_new = argv[++i];
+        }
+        else if (strcmp(argv[i], "--shard") == 0)
+        {
+            if (++i == argc)
+            {
+                disp_usage(argv[0]);
+            }
+            parse_shard(argv[i]);
+        }
+        else if (strcmp(argv[i], "--estimate") == 0)
+        {
+            /* only read a sample of the files */
+            estimate = 1;
+        }
+        else if (strcmp(argv[i], "--estimate-error") == 0)
+        {
+            if (++i == argc)
+            {
+                disp_usage(argv[0]);
+            }
+            /* target relative error, given as a percentage */
+            est_err = parse_num(argv[i]) / 100;
+        }
+        else if (strcmp(argv[i], "--estimate-time") == 0)
+        {
+            if (++i == argc)
+            {
+                disp_usage(argv[0]);
+            }
+            /* time budget for sampling, in seconds */
+            est_time = parse_num(argv[i]);
+        }
         else if (strcmp(argv[i], "-t") == 0)
         {
+            ops[numops++] = i;
             /* check that the next argument exists */
             if (++i == argc)
             {
                 disp_usage(argv[0]);
             }
-            /* tell program not to count pwd */
-            numcounts++;
-            /* count lines from stdin using the given language */
-            count_stdin(argv[i], counts);
         }
-        else if (strcmp(argv[i], "-") == 0)
+        else
         {
-            /* don't count pwd */
-            numcounts++;
-            /* get file list from stdin */
-            get_stdin_filenames(counts);
+            ops[numops++] = i;
         }
-        else
+    }
+
+    /* the records would only be kept in memory for nothing */
+    if (partial_files != 0 && partial_out == NULL)
+    {
+        fprintf(stderr, "error: --partial-files needs --emit-partial!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* keep saving a resumed walk, so that stopping it again loses nothing */
+    if (resume_file != NULL && ckpt_file == NULL)
+    {
+        ckpt_file = resume_file;
+    }
+
+    if (idle != 0)
+    {
+        set_idle();
+    }
+
+    start_time = get_time();
+    if (limit > 0)
+    {
+        deadline = start_time + limit;
+    }
+    run_counts = counts;
+    run_tots = print_tots;
+    setup_signals();
+    if (budget != 0)
+    {
+        budget_start = get_time();
+        bucket_init(&io_bucket, budget_start, BUDGET_BURST_BYTES);
+        bucket_init(&file_bucket, budget_start, BUDGET_BURST_FILES);
+    }
+
+    if (diff_old != NULL)
+    {
+        if (numops != 0 || merge != 0 || partial_out != NULL ||
+            estimate != 0 || shard_cnt != 1 || ckpt_file != NULL ||
+            resume_file != NULL)
+        {
+            fprintf(stderr, "error: --diff cannot be combined with other "
+                    "files or modes!\n");
+            exit(EXIT_FAILURE);
+        }
+        memset(added, 0, sizeof(added));
+        memset(removed, 0, sizeof(removed));
+        memset(changed, 0, sizeof(changed));
+        run_counts = NULL;
+        run_added = added;
+        run_removed = removed;
+        run_changed = changed;
+
+        diff_lines(diff_old, diff_new, added, removed, changed);
+        if (budget != 0)
+        {
+            budget_report();
+        }
+        if (stopped != NULL)
         {
-            /* tell program not to count pwd */
-            numcounts++;
-            /* count lines from the given file */
-            count_lines(argv[i], counts);
+            printf("Partial results (%s):\n", stopped);
         }
+        print_diff(stdout, added, removed, changed, print_tots);
+
+        free(ops);
+        return (stopped != NULL) ? EXIT_PARTIAL : EXIT_SUCCESS;
+    }
+
+    if (estimate != 0 && (merge != 0 || partial_out != NULL))
+    {
+        fprintf(stderr, "error: --estimate cannot be used with partial "
+                "files!\n");
+        exit(EXIT_FAILURE);
+    }
+    if ((ckpt_file != NULL || resume_file != NULL) &&
+        (merge != 0 || estimate != 0))
+    {
+        fprintf(stderr, "error: checkpoints can only be used when counting "
+                "files!\n");
+        exit(EXIT_FAILURE);
     }
 
-    /* if no counts were performed, count the pwd */
-    if (numcounts == 0)
+    if (merge != 0)
+    {
+        if (numops == 0)
+        {
+            disp_usage(argv[0]);
+        }
+        for (i = 0; i < numops; i++)
+        {
+            if (strcmp(argv[ops[i]], "-t") == 0)
+            {
+                fprintf(stderr, "error: -t cannot be used with --merge!\n");
+                exit(EXIT_FAILURE);
+            }
+            /* '-' reads a partial file from stdin */
+            read_partial(argv[ops[i]], counts);
+        }
+    }
+    else
     {
-        /* pwd is dynamically allocated */
-        pwd = getcwd(NULL, 0);
-        count_lines(pwd, counts);
+        /* with no arguments, count the pwd (dynamically allocated) */
+        if (numops == 0)
+        {
+            pwd = getcwd(NULL, 0);
+        }
+
+        if (ckpt_file != NULL || resume_file != NULL)
+        {
+            ckpt_hash = args_hash(argv, ops, numops);
+        }
+        if (resume_file != NULL)
+        {
+            read_checkpoint(resume_file, counts);
+        }
+
+        /* count the files up front, so that an ETA can be given */
+        if (progress != 0 && estimate == 0)
+        {
+            found = 0;
+            for (i = 0; i < numops; i++)
+            {
+                j = ops[i];
+                if (strcmp(argv[j], "-t") != 0 && strcmp(argv[j], "-") != 0)
+                {
+                    shard_root = argv[j];
+                    found += precount(argv[j]);
+                }
+            }
+            if (numops == 0)
+            {
+                shard_root = pwd;
+                found += precount(pwd);
+            }
+            shard_root = NULL;
+            /* an unfinished pre-count is not a total */
+            if (stopped == NULL)
+            {
+                total_files = found;
+            }
+        }
+
+        for (i = ckpt_op; i < numops && stopped == NULL; i++)
+        {
+            j = ops[i];
+            if (strcmp(argv[j], "-t") == 0)
+            {
+                /* count lines from stdin using the given language */
+                count_stdin(argv[j + 1], counts);
+            }
+            else if (strcmp(argv[j], "-") == 0)
+            {
+                /* get file list from stdin */
+                get_stdin_filenames(counts);
+            }
+            else
+            {
+                /* count lines from the given file */
+                shard_root = argv[j];
+                count_lines(argv[j], counts);
+                shard_root = NULL;
+            }
+            finish_operand(i + 1);
+        }
+
+        /* if no counts were performed, count the pwd */
+        if (numops == 0 && ckpt_op == 0)
+        {
+            shard_root = pwd;
+            count_lines(pwd, counts);
+            finish_operand(1);
+        }
+        shard_root = NULL;
         free(pwd);
     }
 
-    /* print the results */
-    print_sloc(counts, print_tots);
+    free(ops);
+
+    if (estimate != 0)
+    {
+        /* default to a 5% error bound unless only a time budget is given */
+        if (est_err < 0)
+        {
+            est_err = (est_time > 0) ? 0 : EST_DEF_ERR;
+        }
+        estimate_counts(counts, est_err, est_time, hw, sampled);
+    }
+
+    if (budget != 0)
+    {
+        budget_report();
+    }
+
+    /* a finished walk has nothing left to resume */
+    if (ckpt_file != NULL)
+    {
+        if (stopped != NULL)
+        {
+            write_checkpoint();
+        }
+        else
+        {
+            remove(ckpt_file);
+        }
+    }
+
+    if (partial_out != NULL)
+    {
+        write_partial(partial_out, counts);
+    }
+
+    /* print the results, unless stdout was used for the partial file */
+    if (partial_out == NULL || strcmp(partial_out, "-") != 0)
+    {
+        if (stopped != NULL)
+        {
+            printf("Partial results (%s):\n", stopped);
+        }
+        print_sloc(stdout, counts, print_tots);
+    }
+    else if (stopped != NULL)
+    {
+        fprintf(stderr, "warning: partial results (%s)\n", stopped);
+    }
+    if (estimate != 0)
+    {
+        print_estimate(counts, hw, sampled, print_tots);
+    }
 
-    return EXIT_SUCCESS;
+    /* let scripts tell a partial count from a complete one */
+    return (stopped != NULL) ? EXIT_PARTIAL : EXIT_SUCCESS;
 }
 
 void disp_version(void)
@@ -105,7 +548,15 @@ void disp_version(void)
 
 void disp_usage(char *prog)
 {
-    printf("usage: %s [-v] [-h] [-n] [-t lang] [-] [file] [...]\n", prog);
+    printf("usage: %s [-v] [-h] [-n] [--shard i/N] [--emit-partial file]\n"
+           "       [--partial-files] [--merge] [--estimate]\n"
+           "       [--estimate-error pct] [--estimate-time secs]\n"
+           "       [--io-rate bytes] [--file-rate files] [--cpu pct] [--idle]\n"
+           "       [--progress] [--deadline secs] [--checkpoint file]\n"
+           "       [--checkpoint-interval secs] [--resume file]\n"
+           "       [--diff old new]\n"
+           "       [-t lang] [-] [file] [...]\n",
+           prog);
     exit(EXIT_SUCCESS);
 }
 
@@ -127,20 +578,61 @@ void count_lines(char *filename, sloc_t *counts)
 {
     struct stat sb;
     int         lang;
+    sloc_t      file = {0, 0, 0, 0, 0};
 
-    if (stat(filename, &sb) == -1)
+    if (sig_pending != 0)
+    {
+        poll_signals();
+    }
+    if (stopped != NULL || stat(filename, &sb) == -1)
     {
         return;
     }
+    if (resume_path != NULL && strcmp(filename, resume_path) == 0)
+    {
+        /* the last file counted before the checkpoint */
+        free(resume_path);
+        resume_path = NULL;
+        return;
+    }
 
     if (S_ISDIR(sb.st_mode) != 0)
     {
         count_folder(filename, counts);
     }
     else if ( S_ISREG(sb.st_mode) != 0 &&
-              (lang = get_file_lang(filename)) != -1)
+              (lang = get_file_lang(filename)) != -1 &&
+              in_shard(filename) != 0)
     {
-        count_file(filename, counts + lang, lang);
+        if (estimate != 0)
+        {
+            /* only sizes are needed until the sample is chosen */
+            add_est_file(filename, lang, sb.st_size);
+            return;
+        }
+        count_file(filename, &file, lang);
+        if (stopped != NULL)
+        {
+            /* the file was only partly counted */
+            return;
+        }
+        add_sloc(counts + lang, &file);
+        done_files++;
+        done_bytes += sb.st_size;
+        if (partial_files != 0 && file.files != 0)
+        {
+            add_file_record(filename, lang, &file);
+        }
+        if (ckpt_file != NULL)
+        {
+            /* only save between files, when the counts are consistent */
+            strncpy(last_done, filename, BUFSIZ - 1);
+            if (ckpt_due != 0)
+            {
+                ckpt_due = 0;
+                write_checkpoint();
+            }
+        }
     }
 }
 
@@ -149,7 +641,7 @@ void get_stdin_filenames(sloc_t *counts)
     char    name[BUFSIZ];
     char *  nl;
 
-    while (fgets(name, BUFSIZ, stdin) != NULL)
+    while (stopped == NULL && fgets(name, BUFSIZ, stdin) != NULL)
     {
         nl = strchr(name, '\n');
         if (nl != NULL)
@@ -194,16 +686,21 @@ void count_file(char *filename, sloc_t *counter, int lang)
 {
     FILE *  fp;
 
+    if (budget != 0)
+    {
+        budget_open();
+    }
     fp = fopen(filename, "r");
     if (fp != NULL)
     {
-        count_stream(fp, counter, lang);
+        count_stream(fp, counter, lang, detect_encoding(fp));
     }
 }
 
 void count_stdin(char *lang, sloc_t *counts)
 {
     int idxlang;
+    int enc;
 
     idxlang = get_lang_idx(lang);
     if (idxlang == -1)
@@ -211,11 +708,93 @@ void count_stdin(char *lang, sloc_t *counts)
         fprintf(stderr, "error: '%s' is not a known language!\n", lang);
         exit(EXIT_FAILURE);
     }
-    count_stream(stdin, &counts[idxlang], idxlang);
+    /* the encoding can only be sniffed if stdin can be rewound */
+    enc = (fseek(stdin, 0, SEEK_CUR) == 0) ? detect_encoding(stdin) : ENC_UTF8;
+    count_stream(stdin, &counts[idxlang], idxlang, enc);
+}
+
+int detect_encoding(FILE *fp)
+{
+    unsigned char   b[4];
+    size_t          n;
+    long            start;
+    long            skip = 0;
+    int             enc = ENC_UTF8;
+
+    start = ftell(fp);
+    n = fread(b, 1, 4, fp);
+
+    if (n >= 3 && b[0] == 0xef && b[1] == 0xbb && b[2] == 0xbf)
+    {
+        skip = 3;
+    }
+    else if (n >= 2 && b[0] == 0xff && b[1] == 0xfe)
+    {
+        enc = ENC_UTF16LE;
+        skip = 2;
+    }
+    else if (n >= 2 && b[0] == 0xfe && b[1] == 0xff)
+    {
+        enc = ENC_UTF16BE;
+        skip = 2;
+    }
+    else if (n == 4 && b[0] != 0 && b[1] == 0 && b[2] != 0 && b[3] == 0)
+    {
+        /* no BOM, but ASCII text with every other byte NUL */
+        enc = ENC_UTF16LE;
+    }
+    else if (n == 4 && b[0] == 0 && b[1] != 0 && b[2] == 0 && b[3] != 0)
+    {
+        enc = ENC_UTF16BE;
+    }
+
+    /* skip the BOM, if any */
+    clearerr(fp);
+    fseek(fp, start + skip, SEEK_SET);
+    return enc;
+}
+
+char *fgets16(char *s, int size, FILE *fp, int enc)
+{
+    int             i = 0;
+    int             lo;
+    int             hi;
+    unsigned int    unit;
+
+    while (i < size - 1)
+    {
+        if ((lo = getc_unlocked(fp)) == EOF || (hi = getc_unlocked(fp)) == EOF)
+        {
+            break;
+        }
+        if (enc == ENC_UTF16BE)
+        {
+            unit = (lo << 8) | hi;
+        }
+        else
+        {
+            unit = (hi << 8) | lo;
+        }
+
+        /* the scanner only looks at ASCII, so any other code unit (and a
+         * stray NUL) just needs to be a character that is not blank */
+        s[i++] = (unit != 0 && unit < 0x80) ? (char)unit : NON_ASCII;
+        if (unit == '\n')
+        {
+            break;
+        }
+    }
+
+    if (i == 0)
+    {
+        return NULL;
+    }
+    s[i] = '\0';
+    return s;
 }
 
 /* this method sucks - I should really rewrite it */
-void count_stream(FILE *fp, sloc_t *counter, int lang)
+void count_stream(FILE *fp, sloc_t *counter, int lang, int enc)
 {
     char    s[BUFSIZ];
     char    codeline = 0;
@@ -223,14 +802,34 @@ void count_stream(FILE *fp, sloc_t *counter, int lang)
     char    comment = 0;
     char    eol = 0;
     char *  pos;
+    size_t  pending = 0;
+    size_t  width = (enc == ENC_UTF8) ? 1 : 2;
 
     counter->files++;
 
     /* loop through doc */
-    while (fgets(s, BUFSIZ, fp) != NULL)
+    while ((enc == ENC_UTF8 ? fgets(s, BUFSIZ, fp) :
+                              fgets16(s, BUFSIZ, fp, enc)) != NULL)
     {
-        /* loop through line */
-        for (pos = s; pos < s + BUFSIZ; pos++)
+        /* a single load per line; signals are rare */
+        if (sig_pending != 0 && poll_signals() != 0)
+        {
+            break;
+        }
+
+        /* only check the budget once per chunk, not once per line */
+        if (budget != 0)
+        {
+            pending += strlen(s) * width;
+            if (pending >= BUDGET_CHUNK)
+            {
+                budget_read(pending);
+                pending = 0;
+            }
+        }
+
+        /* loop through line */
+        for (pos = s; pos < s + BUFSIZ; pos++)
         {
             /* comment switch */
             switch (comment)
@@ -323,6 +922,11 @@ void count_stream(FILE *fp, sloc_t *counter, int lang)
         }
     }
 
+    if (budget != 0)
+    {
+        budget_read(pending);
+        drop_cache(fp);
+    }
     fclose(fp);
 }
 
@@ -332,6 +936,14 @@ void count_folder(char *dirname, sloc_t *counts)
     int             idx;            /* index of the NULL byte in 'path' */
     DIR *           dp;
     struct dirent * next;
+    char *          parent = cur_dir;
+
+    /* the order only matters to checkpoints */
+    if (ckpt_file != NULL || resume_path != NULL)
+    {
+        count_folder_sorted(dirname, counts);
+        return;
+    }
 
     strncpy(path, dirname, BUFSIZ - 1);
     path[BUFSIZ - 2] = '\0';
@@ -344,7 +956,8 @@ void count_folder(char *dirname, sloc_t *counts)
         return;
     }
 
-    while ((next = readdir(dp)) != NULL)
+    cur_dir = dirname;
+    while (stopped == NULL && (next = readdir(dp)) != NULL)
     {
         if (*(next->d_name) != '.')
         {
@@ -352,11 +965,1618 @@ void count_folder(char *dirname, sloc_t *counts)
             count_lines(path, counts);
         }
     }
+    cur_dir = parent;
 
     closedir(dp);
 }
 
-void print_sloc(sloc_t *counts, int print_tots)
+void count_folder_sorted(char *dirname, sloc_t *counts)
+{
+    char            path[BUFSIZ];   /* path to the next file */
+    int             idx;            /* index of the NULL byte in 'path' */
+    struct dirent **list;
+    int             n;
+    int             i;
+    char *          parent = cur_dir;
+
+    strncpy(path, dirname, BUFSIZ - 1);
+    path[BUFSIZ - 2] = '\0';
+    idx = strlen(path);
+    path[idx] = '/';
+    idx++;
+
+    /* sorted, so that a checkpoint can tell how far the walk has got */
+    if ((n = scandir(dirname, &list, dirent_visible, cmp_dirent)) == -1)
+    {
+        return;
+    }
+
+    cur_dir = dirname;
+    for (i = 0; i < n && stopped == NULL; i++)
+    {
+        strncpy(path + idx, list[i]->d_name, BUFSIZ - idx - 1);
+        if (resume_path != NULL && resume_cmp(path, idx) < 0)
+        {
+            /* counted before the checkpoint */
+            continue;
+        }
+        count_lines(path, counts);
+    }
+    cur_dir = parent;
+
+    free_dir_list(list, n);
+}
+
+void parse_shard(char *spec)
+{
+    char    extra;
+
+    if (sscanf(spec, "%d/%d%c", &shard_idx, &shard_cnt, &extra) != 2 ||
+        shard_cnt < 1 || shard_idx < 0 || shard_idx >= shard_cnt)
+    {
+        fprintf(stderr, "error: '%s' is not a valid shard (use i/N with "
+                "0 <= i < N)!\n", spec);
+        exit(EXIT_FAILURE);
+    }
+}
+
+unsigned long hash_path(char *path)
+{
+    unsigned long   h = 2166136261UL;
+
+    /* 32-bit FNV-1a, so every machine splits the tree the same way */
+    while (*path != '\0')
+    {
+        h ^= (unsigned char)*path++;
+        h = (h * 16777619UL) & 0xffffffffUL;
+    }
+    return h;
+}
+
+int in_shard(char *path)
+{
+    size_t  len;
+
+    if (shard_cnt == 1)
+    {
+        return 1;
+    }
+
+    /* hash the path below the operand, so the mount point doesn't matter */
+    len = (shard_root != NULL) ? strlen(shard_root) : 0;
+    if (len != 0 && strncmp(path, shard_root, len) == 0)
+    {
+        if (path[len] == '\0' && strrchr(path, '/') != NULL)
+        {
+            /* the operand is the file itself */
+            path = strrchr(path, '/') + 1;
+        }
+        else if (path[len] != '\0')
+        {
+            path += len;
+            while (*path == '/')
+            {
+                path++;
+            }
+        }
+    }
+    return (hash_path(path) % shard_cnt) == shard_idx;
+}
+
+void add_sloc(sloc_t *dst, sloc_t *src)
+{
+    dst->tot += src->tot;
+    dst->code += src->code;
+    dst->com += src->com;
+    dst->blank += src->blank;
+    dst->files += src->files;
+}
+
+void add_file_record(char *path, int lang, sloc_t *counts)
+{
+    sloc_file_t *   recs;
+
+    if (num_file_recs == max_file_recs)
+    {
+        max_file_recs = (max_file_recs == 0) ? 64 : max_file_recs * 2;
+        recs = (sloc_file_t *)realloc(file_recs,
+                                      max_file_recs * sizeof(sloc_file_t));
+        if (recs == NULL)
+        {
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+        file_recs = recs;
+    }
+
+    file_recs[num_file_recs].lang = lang;
+    file_recs[num_file_recs].path = strdup(path);
+    file_recs[num_file_recs].counts = *counts;
+    if (file_recs[num_file_recs].path == NULL)
+    {
+        perror("strdup");
+        exit(EXIT_FAILURE);
+    }
+    num_file_recs++;
+}
+
+void write_u32(FILE *fp, unsigned long n)
+{
+    putc(n & 0xff, fp);
+    putc((n >> 8) & 0xff, fp);
+    putc((n >> 16) & 0xff, fp);
+    putc((n >> 24) & 0xff, fp);
+}
+
+int read_u32(FILE *fp, unsigned long *n)
+{
+    unsigned char   b[4];
+
+    if (fread(b, 1, 4, fp) != 4)
+    {
+        return -1;
+    }
+    *n = (unsigned long)b[0] | ((unsigned long)b[1] << 8) |
+         ((unsigned long)b[2] << 16) | ((unsigned long)b[3] << 24);
+    return 0;
+}
+
+void write_str(FILE *fp, char *s)
+{
+    size_t  len = strlen(s);
+
+    write_u32(fp, len);
+    fwrite(s, 1, len, fp);
+}
+
+char *read_str(FILE *fp)
+{
+    unsigned long   len;
+    char *          s;
+
+    if (read_u32(fp, &len) == -1 || len > PARTIAL_MAX_STR)
+    {
+        return NULL;
+    }
+    s = (char *)malloc(len + 1);
+    if (s == NULL)
+    {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    if (fread(s, 1, len, fp) != len)
+    {
+        free(s);
+        return NULL;
+    }
+    s[len] = '\0';
+    return s;
+}
+
+void write_sloc(FILE *fp, sloc_t *counts)
+{
+    write_u32(fp, counts->tot);
+    write_u32(fp, counts->code);
+    write_u32(fp, counts->com);
+    write_u32(fp, counts->blank);
+    write_u32(fp, counts->files);
+}
+
+int read_sloc(FILE *fp, sloc_t *counts)
+{
+    unsigned long   n[5];
+    int             i;
+
+    for (i = 0; i < 5; i++)
+    {
+        if (read_u32(fp, &n[i]) == -1)
+        {
+            return -1;
+        }
+    }
+    counts->tot = n[0];
+    counts->code = n[1];
+    counts->com = n[2];
+    counts->blank = n[3];
+    counts->files = n[4];
+    return 0;
+}
+
+void write_partial(char *filename, sloc_t *counts)
+{
+    FILE *  fp;
+
+    if (strcmp(filename, "-") == 0)
+    {
+        fp = stdout;
+    }
+    else if ((fp = fopen(filename, "wb")) == NULL)
+    {
+        perror(filename);
+        exit(EXIT_FAILURE);
+    }
+
+    fwrite(PARTIAL_MAGIC, 1, sizeof(PARTIAL_MAGIC) - 1, fp);
+    write_u32(fp, PARTIAL_VERSION);
+    write_u32(fp, (stopped != NULL) ? PARTIAL_INCOMPLETE : 0);
+    write_partial_body(fp, counts);
+
+    if (fflush(fp) == EOF || ferror(fp) != 0 ||
+        (fp != stdout && fclose(fp) == EOF))
+    {
+        perror(filename);
+        exit(EXIT_FAILURE);
+    }
+}
+
+void write_partial_body(FILE *fp, sloc_t *counts)
+{
+    int     i;
+    int     nlangs = 0;
+
+    for (i = 0; i < NUM_LANGS; i++)
+    {
+        if (counts[i].files != 0)
+        {
+            nlangs++;
+        }
+    }
+
+    write_u32(fp, nlangs);
+    write_u32(fp, num_file_recs);
+
+    /* languages are stored by name so partials from other builds merge */
+    for (i = 0; i < NUM_LANGS; i++)
+    {
+        if (counts[i].files != 0)
+        {
+            write_str(fp, langs[i].name);
+            write_sloc(fp, &counts[i]);
+        }
+    }
+    for (i = 0; i < num_file_recs; i++)
+    {
+        write_str(fp, langs[file_recs[i].lang].name);
+        write_str(fp, file_recs[i].path);
+        write_sloc(fp, &file_recs[i].counts);
+    }
+}
+
+void read_partial(char *filename, sloc_t *counts)
+{
+    FILE *          fp;
+    char            magic[sizeof(PARTIAL_MAGIC) - 1];
+    unsigned long   version;
+    unsigned long   flags;
+
+    if (strcmp(filename, "-") == 0)
+    {
+        fp = stdin;
+    }
+    else if ((fp = fopen(filename, "rb")) == NULL)
+    {
+        perror(filename);
+        exit(EXIT_FAILURE);
+    }
+
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) ||
+        memcmp(magic, PARTIAL_MAGIC, sizeof(magic)) != 0 ||
+        read_u32(fp, &version) == -1)
+    {
+        fprintf(stderr, "error: '%s' is not a partial file!\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    if (version != PARTIAL_VERSION)
+    {
+        fprintf(stderr, "error: '%s' has unsupported version %lu!\n",
+                filename, version);
+        exit(EXIT_FAILURE);
+    }
+    if (read_u32(fp, &flags) == -1)
+    {
+        bad_partial(filename);
+    }
+    if ((flags & PARTIAL_INCOMPLETE) != 0)
+    {
+        /* anything merged with a partial result is partial too */
+        stopped = "merged a partial result";
+    }
+    read_partial_body(fp, filename, counts);
+
+    if (fp != stdin)
+    {
+        fclose(fp);
+    }
+}
+
+void read_partial_body(FILE *fp, char *filename, sloc_t *counts)
+{
+    unsigned long   nlangs;
+    unsigned long   nfiles;
+    unsigned long   i;
+    char *          name;
+    char *          path;
+    int             lang;
+    sloc_t          s;
+
+    if (read_u32(fp, &nlangs) == -1 || read_u32(fp, &nfiles) == -1)
+    {
+        bad_partial(filename);
+    }
+
+    for (i = 0; i < nlangs + nfiles; i++)
+    {
+        path = NULL;
+        if ((name = read_str(fp)) == NULL ||
+            (i >= nlangs && (path = read_str(fp)) == NULL) ||
+            read_sloc(fp, &s) == -1)
+        {
+            bad_partial(filename);
+        }
+        if ((lang = get_lang_idx(name)) == -1)
+        {
+            fprintf(stderr, "error: '%s' has unknown language '%s'!\n",
+                    filename, name);
+            exit(EXIT_FAILURE);
+        }
+
+        if (path == NULL)
+        {
+            add_sloc(&counts[lang], &s);
+        }
+        else if (partial_files != 0)
+        {
+            /* carry the per-file records over into the merged partial */
+            add_file_record(path, lang, &s);
+        }
+        free(name);
+        free(path);
+    }
+}
+
+void bad_partial(char *filename)
+{
+    fprintf(stderr, "error: '%s' is truncated or corrupt!\n", filename);
+    exit(EXIT_FAILURE);
+}
+
+double parse_num(char *s)
+{
+    char *  end;
+    double  n;
+
+    n = strtod(s, &end);
+    if (end == s || *end != '\0' || n < 0)
+    {
+        fprintf(stderr, "error: '%s' is not a valid number!\n", s);
+        exit(EXIT_FAILURE);
+    }
+    return n;
+}
+
+double get_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void add_est_file(char *path, int lang, off_t size)
+{
+    est_file_t *    files;
+
+    if (num_est_files == max_est_files)
+    {
+        max_est_files = (max_est_files == 0) ? 64 : max_est_files * 2;
+        files = (est_file_t *)realloc(est_files,
+                                      max_est_files * sizeof(est_file_t));
+        if (files == NULL)
+        {
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+        est_files = files;
+    }
+
+    est_files[num_est_files].lang = lang;
+    est_files[num_est_files].size = size;
+    est_files[num_est_files].path = strdup(path);
+    if (est_files[num_est_files].path == NULL)
+    {
+        perror("strdup");
+        exit(EXIT_FAILURE);
+    }
+    num_est_files++;
+}
+
+int cmp_est_file(const void *a, const void *b)
+{
+    const est_file_t *  fa = a;
+    const est_file_t *  fb = b;
+
+    if (fa->lang != fb->lang)
+    {
+        return fa->lang - fb->lang;
+    }
+    return (fa->size > fb->size) - (fa->size < fb->size);
+}
+
+void est_sample(est_lang_t *e, int h)
+{
+    est_file_t *    f;
+    sloc_t          s = {0, 0, 0, 0, 0};
+    double          v[NUM_MEMBERS];
+    double          x;
+    int             m;
+
+    f = &e->files[e->start[h] + e->n[h]];
+    count_file(f->path, &s, f->lang);
+    if (stopped != NULL)
+    {
+        return;
+    }
+    e->n[h]++;
+    done_files++;
+    done_bytes += f->size;
+
+    v[IDX_TOT] = s.tot;
+    v[IDX_CODE] = s.code;
+    v[IDX_COM] = s.com;
+    v[IDX_BLANK] = s.blank;
+    x = f->size;
+    e->sumx[h] += x;
+    e->sumxx[h] += x * x;
+    for (m = IDX_TOT; m <= IDX_BLANK; m++)
+    {
+        e->sum[h][m] += v[m];
+        e->sumsq[h][m] += v[m] * v[m];
+        e->sumxy[h][m] += x * v[m];
+    }
+}
+
+void est_bounds(est_lang_t *e, double *est, double *hw)
+{
+    int     h;
+    int     m;
+    double  nh;
+    double  bigh;
+    double  ratio;
+    double  mean;
+    double  s2;
+    double  var;
+
+    for (m = IDX_TOT; m <= IDX_BLANK; m++)
+    {
+        est[m] = 0;
+        var = 0;
+        for (h = 0; h <= EST_STRATA; h++)
+        {
+            nh = e->n[h];
+            bigh = e->start[h + 1] - e->start[h];
+            if (bigh == 0 || nh == 0)
+            {
+                /* nh is only 0 if counting was stopped early */
+                continue;
+            }
+
+            mean = e->sum[h][m] / nh;
+            if (e->sumx[h] > 0)
+            {
+                /* lines per byte of the sample, times the bytes of the
+                 * whole stratum, which are already known */
+                ratio = e->sum[h][m] / e->sumx[h];
+                est[m] += ratio * e->bytes[h];
+                s2 = e->sumsq[h][m] - 2 * ratio * e->sumxy[h][m] +
+                     ratio * ratio * e->sumxx[h];
+            }
+            else
+            {
+                est[m] += bigh * mean;
+                s2 = e->sumsq[h][m] - nh * mean * mean;
+            }
+
+            if (nh == bigh)
+            {
+                /* counted in full, so there is no error */
+                continue;
+            }
+            if (nh >= 2)
+            {
+                s2 = MAX(s2 / (nh - 1), 0);
+            }
+            else
+            {
+                /* no spread is known from one file; assume it is large */
+                s2 = mean * mean;
+            }
+            /* a sample that happens to agree perfectly says little about
+             * the rest of the stratum */
+            s2 = MAX(s2, EST_MIN_CV * EST_MIN_CV * MAX(mean * mean, 1));
+            var += bigh * bigh * (1 - nh / bigh) * s2 / nh;
+        }
+        hw[m] = EST_Z * sqrt(var);
+    }
+}
+
+int est_done(est_lang_t *e, double err)
+{
+    int     h;
+    int     bigh;
+    double  est[NUM_MEMBERS];
+    double  hw[NUM_MEMBERS];
+
+    if (e->n[EST_STRATA] < e->start[EST_STRATA + 1] - e->start[EST_STRATA])
+    {
+        return 0;
+    }
+    for (h = 0; h < EST_STRATA; h++)
+    {
+        bigh = e->start[h + 1] - e->start[h];
+        if (e->n[h] < MIN(bigh, EST_MIN_SAMPLE))
+        {
+            return 0;
+        }
+    }
+    est_bounds(e, est, hw);
+    return hw[IDX_CODE] <= err * est[IDX_CODE];
+}
+
+void est_strata(est_lang_t *e)
+{
+    est_file_t  tmp;
+    double      total = 0;
+    double      sum = 0;
+    int         census;
+    int         h = 1;
+    int         i;
+    int         j;
+
+    for (i = 0; i < e->num; i++)
+    {
+        total += e->files[i].size;
+    }
+
+    /* files that are a large share of the bytes are counted in full, since
+     * a sample that misses them is badly wrong */
+    for (census = e->num; census > 0 &&
+         e->files[census - 1].size * EST_CENSUS >= total; census--)
+    {
+        e->bytes[EST_STRATA] += e->files[census - 1].size;
+    }
+    total -= e->bytes[EST_STRATA];
+    e->start[EST_STRATA] = census;
+    e->start[EST_STRATA + 1] = e->num;
+
+    /* split the rest into strata holding equal numbers of bytes */
+    e->start[0] = 0;
+    for (i = 0; i < census; i++)
+    {
+        sum += e->files[i].size;
+        e->bytes[h - 1] += e->files[i].size;
+        while (h < EST_STRATA && sum >= total * h / EST_STRATA)
+        {
+            e->start[h++] = i + 1;
+        }
+    }
+    while (h < EST_STRATA)
+    {
+        e->start[h++] = census;
+    }
+
+    /* shuffle each stratum so it can be sampled from the front */
+    for (h = 0; h <= EST_STRATA; h++)
+    {
+        for (i = e->start[h + 1] - 1; i > e->start[h]; i--)
+        {
+            j = e->start[h] + rand() % (i - e->start[h] + 1);
+            tmp = e->files[i];
+            e->files[i] = e->files[j];
+            e->files[j] = tmp;
+        }
+    }
+}
+
+void estimate_counts(sloc_t *counts, double err, double time_budget,
+                     double hw[][NUM_MEMBERS], int *sampled)
+{
+    est_lang_t  est[NUM_LANGS];
+    double      start;
+    double      e[NUM_MEMBERS];
+    int         first;
+    int         left;
+    int         i;
+    int         j;
+    int         h;
+
+    start = get_time();
+    srand(time(NULL) ^ getpid());
+
+    /* group the files by language, sorted by size within a language */
+    qsort(est_files, num_est_files, sizeof(est_file_t), cmp_est_file);
+    memset(est, 0, sizeof(est));
+    for (i = 0; i < num_est_files; i = j)
+    {
+        for (j = i; j < num_est_files && est_files[j].lang == est_files[i].lang;
+             j++)
+            ;
+        est[est_files[i].lang].files = &est_files[i];
+        est[est_files[i].lang].num = j - i;
+    }
+
+    for (i = 0; i < NUM_LANGS; i++)
+    {
+        est_strata(&est[i]);
+        est[i].done = (est[i].num == 0);
+    }
+
+    /* sample one file per stratum per round, always taking at least one
+     * file from every stratum so that every stratum can be extrapolated.
+     * the largest files are sampled the same way, so the time budget also
+     * holds while they are counted */
+    for (first = 1, left = 1; left != 0; first = 0)
+    {
+        left = 0;
+        for (i = 0; i < NUM_LANGS; i++)
+        {
+            if (est[i].done != 0)
+            {
+                continue;
+            }
+            for (h = 0; h <= EST_STRATA; h++)
+            {
+                if (est[i].n[h] < est[i].start[h + 1] - est[i].start[h] &&
+                    stopped == NULL && (first != 0 || time_budget <= 0 ||
+                                        get_time() - start < time_budget))
+                {
+                    est_sample(&est[i], h);
+                    left = 1;
+                }
+            }
+            if (est_done(&est[i], err) != 0)
+            {
+                est[i].done = 1;
+            }
+        }
+    }
+
+    for (i = 0; i < NUM_LANGS; i++)
+    {
+        sampled[i] = 0;
+        memset(hw[i], 0, sizeof(hw[i]));
+        if (est[i].num == 0)
+        {
+            continue;
+        }
+        for (h = 0; h <= EST_STRATA; h++)
+        {
+            sampled[i] += est[i].n[h];
+        }
+        est_bounds(&est[i], e, hw[i]);
+        counts[i].tot += (int)(e[IDX_TOT] + 0.5);
+        counts[i].code += (int)(e[IDX_CODE] + 0.5);
+        counts[i].com += (int)(e[IDX_COM] + 0.5);
+        counts[i].blank += (int)(e[IDX_BLANK] + 0.5);
+        counts[i].files += est[i].num;
+    }
+}
+
+void print_estimate(sloc_t *counts, double hw[][NUM_MEMBERS], int *sampled,
+                    int print_tots)
+{
+    int             i;
+    int             m;
+    int             tot_sampled = 0;
+    double          tot_var[NUM_MEMBERS] = {0};
+    char            s[NUM_MEMBERS][BUFSIZ];
+    int             maxn[NUM_MEMBERS] =
+    {
+        sizeof(STR_LANG) - 1,
+        sizeof(STR_TOT) - 1,
+        sizeof(STR_CODE) - 1,
+        sizeof(STR_COM) - 1,
+        sizeof(STR_BLANK) - 1,
+        sizeof(STR_SAMPLED) - 1,
+    };
+    sloc_list_t *   lst = NULL;
+
+    for (i = 0; i < NUM_LANGS; i++)
+    {
+        if (counts[i].files != 0)
+        {
+            tot_sampled += sampled[i];
+            for (m = IDX_TOT; m <= IDX_BLANK; m++)
+            {
+                /* the languages are sampled independently */
+                tot_var[m] += hw[i][m] * hw[i][m];
+            }
+
+            strcpy(s[IDX_LANG], langs[i].name);
+            snprintf(s[IDX_TOT], BUFSIZ, "%.0f", hw[i][IDX_TOT]);
+            snprintf(s[IDX_CODE], BUFSIZ, "%.0f", hw[i][IDX_CODE]);
+            snprintf(s[IDX_COM], BUFSIZ, "%.0f", hw[i][IDX_COM]);
+            snprintf(s[IDX_BLANK], BUFSIZ, "%.0f", hw[i][IDX_BLANK]);
+            snprintf(s[IDX_FILE], BUFSIZ, "%d", sampled[i]);
+            set_max_lens(s, maxn);
+
+            add_sloc_item(&lst, counts[i].code, s);
+        }
+    }
+
+    if (print_tots != 0)
+    {
+        strcpy(s[IDX_LANG], STR_TOT);
+        snprintf(s[IDX_TOT], BUFSIZ, "%.0f", sqrt(tot_var[IDX_TOT]));
+        snprintf(s[IDX_CODE], BUFSIZ, "%.0f", sqrt(tot_var[IDX_CODE]));
+        snprintf(s[IDX_COM], BUFSIZ, "%.0f", sqrt(tot_var[IDX_COM]));
+        snprintf(s[IDX_BLANK], BUFSIZ, "%.0f", sqrt(tot_var[IDX_BLANK]));
+        snprintf(s[IDX_FILE], BUFSIZ, "%d", tot_sampled);
+        set_max_lens(s, maxn);
+
+        add_sloc_item(&lst, INT_MAX - 1, s);
+    }
+
+    strcpy(s[IDX_LANG], STR_LANG);
+    strcpy(s[IDX_TOT], STR_TOT);
+    strcpy(s[IDX_CODE], STR_CODE);
+    strcpy(s[IDX_COM], STR_COM);
+    strcpy(s[IDX_BLANK], STR_BLANK);
+    strcpy(s[IDX_FILE], STR_SAMPLED);
+
+    add_sloc_item(&lst, INT_MAX, s);
+
+    printf("\nEstimated from a sample, 95%% confidence (+/-):\n");
+    print_sloc_list(stdout, lst, maxn);
+
+    free_sloc_list(lst);
+}
+
+int dirent_visible(const struct dirent *d)
+{
+    return d->d_name[0] != '.';
+}
+
+int cmp_dirent(const struct dirent **a, const struct dirent **b)
+{
+    return strcmp((*a)->d_name, (*b)->d_name);
+}
+
+void free_dir_list(struct dirent **list, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        free(list[i]);
+    }
+    free(list);
+}
+
+void diff_lines(char *oldname, char *newname, sloc_t *added,
+                sloc_t *removed, int *changed)
+{
+    struct stat so;
+    struct stat sn;
+    int         has_old;
+    int         has_new;
+    int         lang;
+
+    has_old = (stat(oldname, &so) == 0);
+    has_new = (stat(newname, &sn) == 0);
+
+    if (has_old && has_new && S_ISDIR(so.st_mode) && S_ISDIR(sn.st_mode))
+    {
+        diff_folder(oldname, newname, added, removed, changed);
+    }
+    else if (has_old && has_new && S_ISREG(so.st_mode) &&
+             S_ISREG(sn.st_mode) && (lang = get_file_lang(newname)) != -1)
+    {
+        diff_file(oldname, &so, newname, &sn, lang, added, removed, changed);
+    }
+    else
+    {
+        /* the paths are not comparable, so count them separately */
+        if (has_old)
+        {
+            count_lines(oldname, removed);
+        }
+        if (has_new)
+        {
+            count_lines(newname, added);
+        }
+    }
+}
+
+void diff_folder(char *olddir, char *newdir, sloc_t *added,
+                 sloc_t *removed, int *changed)
+{
+    char            oldpath[BUFSIZ];
+    char            newpath[BUFSIZ];
+    int             oldidx;
+    int             newidx;
+    struct dirent **oldlist;
+    struct dirent **newlist;
+    int             nold;
+    int             nnew;
+    int             i = 0;
+    int             j = 0;
+    int             cmp;
+
+    strncpy(oldpath, olddir, BUFSIZ - 1);
+    oldpath[BUFSIZ - 2] = '\0';
+    oldidx = strlen(oldpath);
+    oldpath[oldidx++] = '/';
+    oldpath[oldidx] = '\0';
+    strncpy(newpath, newdir, BUFSIZ - 1);
+    newpath[BUFSIZ - 2] = '\0';
+    newidx = strlen(newpath);
+    newpath[newidx++] = '/';
+    newpath[newidx] = '\0';
+
+    if ((nold = scandir(olddir, &oldlist, dirent_visible, cmp_dirent)) == -1)
+    {
+        count_lines(newdir, added);
+        return;
+    }
+    if ((nnew = scandir(newdir, &newlist, dirent_visible, cmp_dirent)) == -1)
+    {
+        free_dir_list(oldlist, nold);
+        count_lines(olddir, removed);
+        return;
+    }
+
+    /* both lists are sorted, so walk them together pairing equal names */
+    while ((i < nold || j < nnew) && stopped == NULL)
+    {
+        if (i == nold)
+        {
+            cmp = 1;
+        }
+        else if (j == nnew)
+        {
+            cmp = -1;
+        }
+        else
+        {
+            cmp = strcmp(oldlist[i]->d_name, newlist[j]->d_name);
+        }
+
+        if (cmp <= 0)
+        {
+            strncpy(oldpath + oldidx, oldlist[i]->d_name, BUFSIZ - oldidx - 1);
+        }
+        if (cmp >= 0)
+        {
+            strncpy(newpath + newidx, newlist[j]->d_name, BUFSIZ - newidx - 1);
+        }
+
+        if (cmp < 0)
+        {
+            count_lines(oldpath, removed);
+            i++;
+        }
+        else if (cmp > 0)
+        {
+            count_lines(newpath, added);
+            j++;
+        }
+        else
+        {
+            diff_lines(oldpath, newpath, added, removed, changed);
+            i++;
+            j++;
+        }
+    }
+
+    free_dir_list(oldlist, nold);
+    free_dir_list(newlist, nnew);
+}
+
+void diff_file(char *oldname, struct stat *so, char *newname,
+               struct stat *sn, int lang, sloc_t *added, sloc_t *removed,
+               int *changed)
+{
+    sloc_t  o = {0, 0, 0, 0, 0};
+    sloc_t  n = {0, 0, 0, 0, 0};
+
+    /* files of the same size are unchanged if they have the same mtime or
+     * the same contents, so most of an upgraded tree is never counted */
+    if (so->st_size == sn->st_size &&
+        (so->st_mtime == sn->st_mtime || same_contents(oldname, newname)))
+    {
+        return;
+    }
+
+    /* only the net change of each count is known, not which lines changed */
+    count_file(oldname, &o, lang);
+    count_file(newname, &n, lang);
+    if (stopped != NULL)
+    {
+        return;
+    }
+    changed[lang]++;
+    done_files++;
+    done_bytes += sn->st_size;
+
+    added[lang].tot += MAX(n.tot - o.tot, 0);
+    added[lang].code += MAX(n.code - o.code, 0);
+    added[lang].com += MAX(n.com - o.com, 0);
+    added[lang].blank += MAX(n.blank - o.blank, 0);
+    removed[lang].tot += MAX(o.tot - n.tot, 0);
+    removed[lang].code += MAX(o.code - n.code, 0);
+    removed[lang].com += MAX(o.com - n.com, 0);
+    removed[lang].blank += MAX(o.blank - n.blank, 0);
+}
+
+int same_contents(char *a, char *b)
+{
+    FILE *  fa;
+    FILE *  fb;
+    char    ba[BUFSIZ];
+    char    bb[BUFSIZ];
+    size_t  na;
+    size_t  nb;
+    int     same = 0;
+
+    if (budget != 0)
+    {
+        budget_open();
+        budget_open();
+    }
+    if ((fa = fopen(a, "rb")) == NULL)
+    {
+        return 0;
+    }
+    if ((fb = fopen(b, "rb")) == NULL)
+    {
+        fclose(fa);
+        return 0;
+    }
+
+    /* stop reading at the first difference */
+    for (;;)
+    {
+        na = fread(ba, 1, BUFSIZ, fa);
+        nb = fread(bb, 1, BUFSIZ, fb);
+        if (budget != 0)
+        {
+            budget_read(na + nb);
+        }
+        if (na != nb || memcmp(ba, bb, na) != 0)
+        {
+            break;
+        }
+        if (na == 0)
+        {
+            same = (ferror(fa) == 0 && ferror(fb) == 0);
+            break;
+        }
+    }
+
+    if (budget != 0)
+    {
+        drop_cache(fa);
+        drop_cache(fb);
+    }
+    fclose(fa);
+    fclose(fb);
+    return same;
+}
+
+void print_diff(FILE *out, sloc_t *added, sloc_t *removed, int *changed,
+                int print_tots)
+{
+    int     i;
+    int     files;
+    sloc_t  tadd = {0, 0, 0, 0, 0};
+    sloc_t  trem = {0, 0, 0, 0, 0};
+    int     tfiles = 0;
+    char    s[NUM_MEMBERS][BUFSIZ];
+    int     maxn[NUM_MEMBERS] =
+    {
+        sizeof(STR_LANG) - 1,
+        sizeof(STR_TOT) - 1,
+        sizeof(STR_CODE) - 1,
+        sizeof(STR_COM) - 1,
+        sizeof(STR_BLANK) - 1,
+        sizeof(STR_FILE) - 1,
+    };
+    sloc_list_t *   lst = NULL;
+
+    for (i = 0; i < NUM_LANGS; i++)
+    {
+        files = added[i].files + removed[i].files + changed[i];
+        if (files != 0)
+        {
+            add_sloc(&tadd, &added[i]);
+            add_sloc(&trem, &removed[i]);
+            tfiles += files;
+
+            strcpy(s[IDX_LANG], langs[i].name);
+            snprintf(s[IDX_TOT], BUFSIZ, "+%d/-%d", added[i].tot,
+                     removed[i].tot);
+            snprintf(s[IDX_CODE], BUFSIZ, "+%d/-%d", added[i].code,
+                     removed[i].code);
+            snprintf(s[IDX_COM], BUFSIZ, "+%d/-%d", added[i].com,
+                     removed[i].com);
+            snprintf(s[IDX_BLANK], BUFSIZ, "+%d/-%d", added[i].blank,
+                     removed[i].blank);
+            snprintf(s[IDX_FILE], BUFSIZ, "%d", files);
+            set_max_lens(s, maxn);
+
+            add_sloc_item(&lst, added[i].code + removed[i].code, s);
+        }
+    }
+
+    if (print_tots != 0)
+    {
+        strcpy(s[IDX_LANG], STR_TOT);
+        snprintf(s[IDX_TOT], BUFSIZ, "+%d/-%d", tadd.tot, trem.tot);
+        snprintf(s[IDX_CODE], BUFSIZ, "+%d/-%d", tadd.code, trem.code);
+        snprintf(s[IDX_COM], BUFSIZ, "+%d/-%d", tadd.com, trem.com);
+        snprintf(s[IDX_BLANK], BUFSIZ, "+%d/-%d", tadd.blank, trem.blank);
+        snprintf(s[IDX_FILE], BUFSIZ, "%d", tfiles);
+        set_max_lens(s, maxn);
+
+        add_sloc_item(&lst, INT_MAX - 1, s);
+    }
+
+    strcpy(s[IDX_LANG], STR_LANG);
+    strcpy(s[IDX_TOT], STR_TOT);
+    strcpy(s[IDX_CODE], STR_CODE);
+    strcpy(s[IDX_COM], STR_COM);
+    strcpy(s[IDX_BLANK], STR_BLANK);
+    strcpy(s[IDX_FILE], STR_FILE);
+
+    add_sloc_item(&lst, INT_MAX, s);
+
+    print_sloc_list(out, lst, maxn);
+
+    free_sloc_list(lst);
+}
+
+double parse_rate(char *s)
+{
+    char *  end;
+    double  n;
+
+    n = strtod(s, &end);
+    switch (*end)
+    {
+    case 'k':   /* fallthrough */
+    case 'K':
+        n *= 1024;
+        end++;
+        break;
+    case 'm':   /* fallthrough */
+    case 'M':
+        n *= 1024 * 1024;
+        end++;
+        break;
+    case 'g':   /* fallthrough */
+    case 'G':
+        n *= 1024 * 1024 * 1024;
+        end++;
+        break;
+    }
+    if (end == s || *end != '\0' || n <= 0)
+    {
+        fprintf(stderr, "error: '%s' is not a valid rate!\n", s);
+        exit(EXIT_FAILURE);
+    }
+    return n;
+}
+
+void sleep_for(double secs)
+{
+    struct timespec ts;
+
+    /* never sleep past the deadline */
+    if (deadline > 0)
+    {
+        secs = MIN(secs, deadline - get_time());
+    }
+    if (stopped != NULL || secs <= 0)
+    {
+        return;
+    }
+
+    ts.tv_sec = (time_t)secs;
+    ts.tv_nsec = (long)((secs - ts.tv_sec) * 1e9);
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+    {
+        if (sig_pending != 0 && poll_signals() != 0)
+        {
+            break;
+        }
+    }
+}
+
+void bucket_init(bucket_t *b, double now, double burst)
+{
+    /* hold a short burst, so small reads do not each have to sleep */
+    b->cap = MAX(b->rate * BUDGET_BURST_SECS, burst);
+    b->tokens = b->cap;
+    b->last = now;
+}
+
+void bucket_take(bucket_t *b, double n)
+{
+    double  now;
+
+    if (b->rate <= 0)
+    {
+        return;
+    }
+
+    now = get_time();
+    b->tokens += (now - b->last) * b->rate;
+    if (b->tokens > b->cap)
+    {
+        b->tokens = b->cap;
+    }
+    b->last = now;
+
+    /* go into debt, then sleep until it is paid off */
+    b->tokens -= n;
+    if (b->tokens < 0)
+    {
+        sleep_for(-b->tokens / b->rate);
+    }
+}
+
+void budget_cpu(void)
+{
+    double  used;
+    double  wall;
+
+    if (cpu_frac <= 0)
+    {
+        return;
+    }
+
+    used = (double)clock() / CLOCKS_PER_SEC;
+    wall = get_time() - budget_start;
+    if (used > cpu_frac * wall)
+    {
+        sleep_for(used / cpu_frac - wall);
+    }
+}
+
+void budget_read(size_t n)
+{
+    bytes_read += n;
+    bucket_take(&io_bucket, n);
+    budget_cpu();
+}
+
+void budget_open(void)
+{
+    files_opened++;
+    bucket_take(&file_bucket, 1);
+    budget_cpu();
+}
+
+void drop_cache(FILE *fp)
+{
+#ifdef POSIX_FADV_DONTNEED
+    /* errors are ignored: the stream may be a pipe */
+    posix_fadvise(fileno(fp), 0, 0, POSIX_FADV_DONTNEED);
+#endif
+}
+
+void set_idle(void)
+{
+#ifdef SCHED_IDLE
+    struct sched_param  param = {0};
+
+    if (sched_setscheduler(0, SCHED_IDLE, &param) == -1)
+    {
+        perror("warning: sched_setscheduler");
+    }
+#endif
+#if defined(__linux__) && defined(SYS_ioprio_set)
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+                IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) == -1)
+    {
+        perror("warning: ioprio_set");
+    }
+#endif
+}
+
+void budget_report(void)
+{
+    double  wall;
+    double  cpu;
+
+    wall = get_time() - budget_start;
+    cpu = (double)clock() / CLOCKS_PER_SEC;
+    if (wall <= 0)
+    {
+        wall = 1e-9;
+    }
+
+    fprintf(stderr, "read %.1f MiB from %ld files in %.1f s: "
+            "%.2f MiB/s, %.1f files/s, %.0f%% cpu\n",
+            bytes_read / (1024 * 1024), files_opened, wall,
+            bytes_read / (1024 * 1024) / wall, files_opened / wall,
+            100 * cpu / wall);
+}
+
+void on_signal(int sig)
+{
+    switch (sig)
+    {
+    case SIGALRM:
+        sig_tick = 1;
+        break;
+    case SIGUSR1:
+        sig_snapshot = 1;
+        break;
+    default:
+        sig_stop = 1;
+        break;
+    }
+    sig_pending = 1;
+}
+
+void setup_signals(void)
+{
+    struct sigaction    sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &sa, NULL);
+    sigaction(SIGALRM, &sa, NULL);
+
+    /* a second interrupt kills the process as usual */
+    sa.sa_flags = SA_RESTART | SA_RESETHAND;
+    sigaction(SIGINT, &sa, NULL);
+
+    if (progress != 0 || deadline > 0 || ckpt_file != NULL)
+    {
+        arm_timer((deadline > 0) ? MIN(PROGRESS_INTERVAL,
+                                       deadline - get_time())
+                                 : PROGRESS_INTERVAL);
+    }
+}
+
+void arm_timer(double first)
+{
+    struct itimerval    it;
+
+    /* a zero it_value would disarm the timer */
+    first = MAX(first, 0.001);
+
+    memset(&it, 0, sizeof(it));
+    it.it_interval.tv_sec = PROGRESS_INTERVAL;
+    it.it_value.tv_sec = (time_t)first;
+    it.it_value.tv_usec = (suseconds_t)((first - (time_t)first) * 1e6);
+    setitimer(ITIMER_REAL, &it, NULL);
+}
+
+int poll_signals(void)
+{
+    double  now;
+
+    sig_pending = 0;
+
+    if (sig_stop != 0)
+    {
+        stopped = "interrupted";
+    }
+    if (sig_tick != 0)
+    {
+        sig_tick = 0;
+        now = get_time();
+        if (deadline > 0 && now >= deadline)
+        {
+            stopped = "deadline reached";
+        }
+        else if (deadline > 0 && deadline - now < PROGRESS_INTERVAL)
+        {
+            /* make the next tick land on the deadline */
+            arm_timer(deadline - now);
+        }
+        if (progress != 0)
+        {
+            print_progress(now);
+        }
+        if (ckpt_file != NULL && now >= ckpt_next)
+        {
+            ckpt_due = 1;
+            ckpt_next = now + ckpt_interval;
+        }
+    }
+    if (sig_snapshot != 0)
+    {
+        sig_snapshot = 0;
+        if (estimate != 0)
+        {
+            /* the counts are only filled in once sampling is finished */
+            fprintf(stderr, "Partial results (snapshot): no totals yet "
+                    "(sampling)\n");
+        }
+        else if (run_added != NULL)
+        {
+            fprintf(stderr, "Partial results (snapshot):\n");
+            print_diff(stderr, run_added, run_removed, run_changed, run_tots);
+        }
+        else if (run_counts != NULL)
+        {
+            fprintf(stderr, "Partial results (snapshot):\n");
+            print_sloc(stderr, run_counts, run_tots);
+        }
+    }
+
+    return stopped != NULL;
+}
+
+void print_progress(double now)
+{
+    double  elapsed = now - start_time;
+    double  rate;
+
+    rate = (elapsed > 0) ? done_files / elapsed : 0;
+    fprintf(stderr, "%ld", done_files);
+    if (total_files >= 0)
+    {
+        fprintf(stderr, "/%ld", total_files);
+    }
+    fprintf(stderr, " files, %.1f files/s, %.2f MiB/s", rate,
+            (elapsed > 0) ? done_bytes / (1024 * 1024) / elapsed : 0);
+    if (total_files >= 0 && rate > 0)
+    {
+        fprintf(stderr, ", ETA %.0fs",
+                MAX(total_files - done_files, 0) / rate);
+    }
+    fprintf(stderr, ", in %s\n", (cur_dir != NULL) ? cur_dir : ".");
+}
+
+long precount(char *filename)
+{
+    struct stat sb;
+
+    if (sig_pending != 0)
+    {
+        poll_signals();
+    }
+    if (stopped != NULL || stat(filename, &sb) == -1)
+    {
+        return 0;
+    }
+
+    if (S_ISDIR(sb.st_mode) != 0)
+    {
+        return precount_folder(filename);
+    }
+    else if (S_ISREG(sb.st_mode) != 0 && get_file_lang(filename) != -1 &&
+             in_shard(filename) != 0)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+long precount_folder(char *dirname)
+{
+    char            path[BUFSIZ];
+    int             idx;
+    DIR *           dp;
+    struct dirent * next;
+    long            n = 0;
+
+    strncpy(path, dirname, BUFSIZ - 1);
+    path[BUFSIZ - 2] = '\0';
+    idx = strlen(path);
+    path[idx] = '/';
+    idx++;
+
+    if ((dp = opendir(dirname)) == NULL)
+    {
+        return 0;
+    }
+
+    while (stopped == NULL && (next = readdir(dp)) != NULL)
+    {
+        /* most entries never reach precount, which would check for these */
+        if (sig_pending != 0)
+        {
+            poll_signals();
+        }
+        if (*(next->d_name) == '.')
+        {
+            continue;
+        }
+        strncpy(path + idx, next->d_name, BUFSIZ - idx - 1);
+
+        /* avoid a stat for each entry when the type is known */
+        switch (next->d_type)
+        {
+        case DT_DIR:
+            n += precount_folder(path);
+            break;
+        case DT_REG:
+            n += (get_file_lang(path) != -1 && in_shard(path) != 0);
+            break;
+        default:
+            n += precount(path);
+            break;
+        }
+    }
+
+    closedir(dp);
+    return n;
+}
+
+unsigned long args_hash(char **argv, int *ops, int numops)
+{
+    unsigned long   h;
+    int             i;
+    char *          cwd;
+
+    /* relative arguments name a different tree from another directory */
+    if ((cwd = getcwd(NULL, 0)) == NULL)
+    {
+        perror("getcwd");
+        exit(EXIT_FAILURE);
+    }
+    h = hash_path(cwd);
+    free(cwd);
+
+    for (i = 0; i < numops; i++)
+    {
+        if (strcmp(argv[ops[i]], "-t") == 0 || strcmp(argv[ops[i]], "-") == 0)
+        {
+            fprintf(stderr, "error: stdin cannot be checkpointed!\n");
+            exit(EXIT_FAILURE);
+        }
+        h = ((h * 16777619UL) ^ hash_path(argv[ops[i]])) & 0xffffffffUL;
+    }
+
+    /* these change which files are counted, or what is saved */
+    h = ((h * 16777619UL) ^ shard_idx) & 0xffffffffUL;
+    h = ((h * 16777619UL) ^ shard_cnt) & 0xffffffffUL;
+    h = ((h * 16777619UL) ^ partial_files) & 0xffffffffUL;
+    return h;
+}
+
+void finish_operand(int next)
+{
+    if (stopped != NULL)
+    {
+        return;
+    }
+    ckpt_op = next;
+    last_done[0] = '\0';
+    free(resume_path);
+    resume_path = NULL;
+}
+
+int resume_cmp(char *path, int idx)
+{
+    char *  comp;
+    size_t  len;
+    int     cmp;
+
+    if (strncmp(path, resume_path, idx) != 0)
+    {
+        cmp = 1;
+    }
+    else
+    {
+        /* compare the name with the same component of the resume path */
+        comp = resume_path + idx;
+        len = strcspn(comp, "/");
+        cmp = strncmp(path + idx, comp, len);
+        if (cmp == 0 && path[idx + len] != '\0')
+        {
+            cmp = 1;
+        }
+    }
+
+    if (cmp > 0)
+    {
+        /* past the point the checkpoint was taken */
+        free(resume_path);
+        resume_path = NULL;
+    }
+    return cmp;
+}
+
+void write_checkpoint(void)
+{
+    char    tmp[BUFSIZ];
+    FILE *  fp;
+
+    snprintf(tmp, BUFSIZ, "%s.tmp", ckpt_file);
+    if ((fp = fopen(tmp, "wb")) == NULL)
+    {
+        perror(tmp);
+        return;
+    }
+
+    fwrite(CKPT_MAGIC, 1, sizeof(CKPT_MAGIC) - 1, fp);
+    write_u32(fp, CKPT_VERSION);
+    write_u32(fp, ckpt_hash);
+    write_u32(fp, ckpt_op);
+    write_str(fp, last_done);
+    write_partial_body(fp, run_counts);
+
+    /* only replace the old checkpoint once the new one is on disk; a
+     * failed checkpoint is not worth stopping a long count for */
+    if (fflush(fp) == EOF || ferror(fp) != 0 || fsync(fileno(fp)) == -1)
+    {
+        perror(tmp);
+        fclose(fp);
+        remove(tmp);
+        return;
+    }
+    if (fclose(fp) == EOF || rename(tmp, ckpt_file) == -1)
+    {
+        perror(ckpt_file);
+        remove(tmp);
+    }
+}
+
+void read_checkpoint(char *filename, sloc_t *counts)
+{
+    FILE *          fp;
+    char            magic[sizeof(CKPT_MAGIC) - 1];
+    unsigned long   version;
+    unsigned long   hash;
+    unsigned long   op;
+    char *          path;
+    int             i;
+
+    if ((fp = fopen(filename, "rb")) == NULL)
+    {
+        perror(filename);
+        exit(EXIT_FAILURE);
+    }
+
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) ||
+        memcmp(magic, CKPT_MAGIC, sizeof(magic)) != 0 ||
+        read_u32(fp, &version) == -1 || version != CKPT_VERSION)
+    {
+        fprintf(stderr, "error: '%s' is not a checkpoint file!\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    if (read_u32(fp, &hash) == -1 || read_u32(fp, &op) == -1 ||
+        (path = read_str(fp)) == NULL)
+    {
+        bad_partial(filename);
+    }
+    if (hash != ckpt_hash)
+    {
+        fprintf(stderr, "error: '%s' was saved with different arguments!\n",
+                filename);
+        exit(EXIT_FAILURE);
+    }
+    read_partial_body(fp, filename, counts);
+    fclose(fp);
+
+    ckpt_op = op;
+    if (*path != '\0')
+    {
+        /* a checkpoint taken before the next file keeps the same place */
+        strncpy(last_done, path, BUFSIZ - 1);
+        resume_path = path;
+    }
+    else
+    {
+        free(path);
+    }
+
+    for (i = 0; i < NUM_LANGS; i++)
+    {
+        done_files += counts[i].files;
+    }
+}
+
+void print_sloc(FILE *out, sloc_t *counts, int print_tots)
 {
     int     i;
     sloc_t  tots;
@@ -425,7 +2645,7 @@ void print_sloc(sloc_t *counts, int print_tots)
 
     add_sloc_item(&lst, INT_MAX, s);
 
-    print_sloc_list(lst, maxn);
+    print_sloc_list(out, lst, maxn);
 
     free_sloc_list(lst);
 }
@@ -491,32 +2711,32 @@ void free_sloc_list(sloc_list_t *lst)
     }
 }
 
-void print_sloc_list(sloc_list_t *list, int *lens)
+void print_sloc_list(FILE *out, sloc_list_t *list, int *lens)
 {
     sloc_list_t *   cur = list;
 
     while (cur != NULL)
     {
-        print_member(cur->name, lens[IDX_LANG]);
-        print_member(cur->files, lens[IDX_FILE]);
-        print_member(cur->code, lens[IDX_CODE]);
-        print_member(cur->com, lens[IDX_COM]);
-        print_member(cur->blank, lens[IDX_BLANK]);
-        print_member(cur->tot, lens[IDX_TOT]);
+        print_member(out, cur->name, lens[IDX_LANG]);
+        print_member(out, cur->files, lens[IDX_FILE]);
+        print_member(out, cur->code, lens[IDX_CODE]);
+        print_member(out, cur->com, lens[IDX_COM]);
+        print_member(out, cur->blank, lens[IDX_BLANK]);
+        print_member(out, cur->tot, lens[IDX_TOT]);
 
-        putchar('\n');
+        putc('\n', out);
 
         cur = cur->next;
     }
 }
 
-void print_member(char *s, int n)
+void print_member(FILE *out, char *s, int n)
 {
     int i;
 
     for (i = 0; i < n - strlen(s); i++)
     {
-        putchar(' ');
+        putc(' ', out);
     }
-    printf("%s"SPACES, s);
+    fprintf(out, "%s"SPACES, s);
 }
@@ -3,7 +3,8 @@
 
 #define VERSION "1.1"
 
-#define MAX(a, b) ((a) > (b)) ? (a) : (b)
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
 
 /* length array indices */
 #define IDX_LANG    0
@@ -21,10 +22,63 @@
 #define STR_COM     "Comment"
 #define STR_BLANK   "Blank"
 #define STR_FILE    "Files"
+#define STR_SAMPLED "Sampled"
+
+/* exit status when counting stopped before it finished */
+#define EXIT_PARTIAL 2
 
 /* number of spaces for print formatting */
 #define SPACES "  "
 
+/* budget mode: bytes read between budget checks, and the burst allowed
+ * by each token bucket, in seconds at the full rate and at least */
+#define BUDGET_CHUNK        65536
+#define BUDGET_BURST_SECS   0.1
+#define BUDGET_BURST_BYTES  65536
+#define BUDGET_BURST_FILES  1
+
+/* ioprio_set(2) has no glibc wrapper or header */
+#define IOPRIO_WHO_PROCESS  1
+#define IOPRIO_CLASS_IDLE   3
+#define IOPRIO_CLASS_SHIFT  13
+
+/* seconds between progress reports and deadline checks */
+#define PROGRESS_INTERVAL   1
+
+/* checkpoint file format, which embeds the body of a partial file, and
+ * the default number of seconds between checkpoints */
+#define CKPT_MAGIC      "SLOCCKPT"
+#define CKPT_VERSION    1
+#define CKPT_INTERVAL   60
+
+/* encodings of a source file */
+#define ENC_UTF8    0
+#define ENC_UTF16LE 1
+#define ENC_UTF16BE 2
+
+/* stands in for non-ASCII UTF-16 code units when scanning a line */
+#define NON_ASCII   '?'
+
+/* partial file format: magic, version, flags, then little-endian 32-bit
+ * fields */
+#define PARTIAL_MAGIC   "SLOCPART"
+#define PARTIAL_VERSION 1
+/* flag set when counting was stopped before it finished */
+#define PARTIAL_INCOMPLETE 1
+/* longest string accepted when reading a partial file */
+#define PARTIAL_MAX_STR 65536
+
+/* estimates: size strata per language, fewest files sampled from a stratum
+ * before stopping, share of a language's bytes (1/EST_CENSUS) that makes a
+ * file always counted, least relative spread assumed for a stratum,
+ * default relative error, and the normal quantile for 95% confidence */
+#define EST_STRATA      4
+#define EST_MIN_SAMPLE  10
+#define EST_CENSUS      100
+#define EST_MIN_CV      0.1
+#define EST_DEF_ERR     0.05
+#define EST_Z           1.96
+
 typedef struct _sloc_t
 {
     int tot;
@@ -34,6 +88,56 @@ typedef struct _sloc_t
     int files;
 } sloc_t;
 
+typedef struct _sloc_file_t
+{
+    int lang;
+    char *path;
+    sloc_t counts;
+} sloc_file_t;
+
+typedef struct _bucket_t
+{
+    /* tokens added per second, or 0 for no limit */
+    double rate;
+    /* most tokens the bucket can hold */
+    double cap;
+    /* tokens in the bucket; negative while the bucket is in debt */
+    double tokens;
+    /* time the bucket was last filled */
+    double last;
+} bucket_t;
+
+typedef struct _est_file_t
+{
+    int lang;
+    off_t size;
+    char *path;
+} est_file_t;
+
+typedef struct _est_lang_t
+{
+    /* the files of the language, sorted by size, then shuffled in strata */
+    est_file_t *files;
+    int num;
+    /* index of the first file in each stratum, plus the end of the last.
+     * the last stratum (EST_STRATA) holds the largest files, which are all
+     * counted unless the time budget runs out */
+    int start[EST_STRATA + 2];
+    /* total size of the files in each stratum */
+    double bytes[EST_STRATA + 1];
+    /* number of files sampled from each stratum so far */
+    int n[EST_STRATA + 1];
+    /* sums over the sample of the sizes, each member, and their products,
+     * by stratum, for the ratio estimate and its variance */
+    double sumx[EST_STRATA + 1];
+    double sumxx[EST_STRATA + 1];
+    double sum[EST_STRATA + 1][NUM_MEMBERS];
+    double sumsq[EST_STRATA + 1][NUM_MEMBERS];
+    double sumxy[EST_STRATA + 1][NUM_MEMBERS];
+    /* nonzero once the error bound is met or every file is sampled */
+    int done;
+} est_lang_t;
+
 typedef struct _sloc_list_t
 {
     int idx;
@@ -135,6 +239,33 @@ void count_file(char *filename, sloc_t *counts, int lang);
  */
 void count_stdin(char *lang, sloc_t *counts);
 
+/*
+ *  detect_encoding
+ *      detects the encoding of a stream from its byte order mark, or from
+ *      the NUL bytes of ASCII text in UTF-16 if it has none. the stream is
+ *      left just past the byte order mark.
+ *  args:
+ *      @fp : a pointer to the seekable stream to check
+ *  return:
+ *      returns ENC_UTF8, ENC_UTF16LE or ENC_UTF16BE
+ */
+int detect_encoding(FILE *fp);
+
+/*
+ *  fgets16
+ *      like fgets, but reads a line of UTF-16 code units. ASCII code units
+ *      are stored as-is and all others as NON_ASCII, which is all that
+ *      count_stream needs to classify the line.
+ *  args:
+ *      @s      : the buffer to store the line in
+ *      @size   : the size of the buffer
+ *      @fp     : the stream to read from
+ *      @enc    : ENC_UTF16LE or ENC_UTF16BE
+ *  return:
+ *      returns s, or NULL if the stream is at its end
+ */
+char *fgets16(char *s, int size, FILE *fp, int enc);
+
 /*
  *  count_stream
  *      counts the number of lines of code in the given file stream
@@ -142,8 +273,9 @@ void count_stdin(char *lang, sloc_t *counts);
  *      @fp     : a pointer to the stream to count
  *      @counts : the sloc counter to add to
  *      @lang   : the language to use
+ *      @enc    : the encoding of the stream
  */
-void count_stream(FILE *fp, sloc_t *counts, int lang);
+void count_stream(FILE *fp, sloc_t *counts, int lang, int enc);
 
 /*
  *  count_folder
@@ -154,15 +286,619 @@ void count_stream(FILE *fp, sloc_t *counts, int lang);
  */
 void count_folder(char *dirname, sloc_t *counts);
 
+/*
+ *  count_folder_sorted
+ *      like count_folder, but visits the entries in sorted order and skips
+ *      the ones counted before the checkpoint being resumed, so that the
+ *      position of a checkpointed walk is well defined
+ *  args:
+ *      @dirname    : the name of the directory to count
+ *      @counts     : the location to store all the file counts
+ */
+void count_folder_sorted(char *dirname, sloc_t *counts);
+
+/*
+ *  parse_shard
+ *      parse a shard specification of the form i/N, where 0 <= i < N, and
+ *      make it the shard counted by this process. exits with an error
+ *      message if the specification is invalid.
+ *  args:
+ *      @spec   : the shard specification
+ */
+void parse_shard(char *spec);
+
+/*
+ *  hash_path
+ *      hash the given path with 32-bit FNV-1a. the result does not depend
+ *      on the host, so separate processes agree on the shard of a file.
+ *  args:
+ *      @path   : the path to hash
+ *  return:
+ *      returns the hash of the path
+ */
+unsigned long hash_path(char *path);
+
+/*
+ *  in_shard
+ *      check whether the given file belongs to the shard being counted. the
+ *      part of the path below the operand being counted is hashed, or the
+ *      file name if the operand is the file itself, so that the shard does
+ *      not depend on where the tree is mounted. files named on stdin are
+ *      hashed by the whole path.
+ *  args:
+ *      @path   : the path of the file
+ *  return:
+ *      returns nonzero if the file should be counted, 0 otherwise
+ */
+int in_shard(char *path);
+
+/*
+ *  add_sloc
+ *      add the line counts in src to the ones in dst
+ *  args:
+ *      @dst    : the counter to add to
+ *      @src    : the counter to add
+ */
+void add_sloc(sloc_t *dst, sloc_t *src);
+
+/*
+ *  add_file_record
+ *      save the counts for a single file so they can be written out as
+ *      part of a partial file
+ *  args:
+ *      @path   : the path of the file
+ *      @lang   : the language of the file
+ *      @counts : the line counts of the file
+ */
+void add_file_record(char *path, int lang, sloc_t *counts);
+
+/*
+ *  write_u32
+ *      write a 32-bit little-endian unsigned number to the given stream
+ *  args:
+ *      @fp : the stream to write to
+ *      @n  : the number to write
+ */
+void write_u32(FILE *fp, unsigned long n);
+
+/*
+ *  read_u32
+ *      read a 32-bit little-endian unsigned number from the given stream
+ *  args:
+ *      @fp : the stream to read from
+ *      @n  : the location to store the number
+ *  return:
+ *      returns 0 on success, or -1 if the stream ended early
+ */
+int read_u32(FILE *fp, unsigned long *n);
+
+/*
+ *  write_str
+ *      write a length-prefixed string to the given stream
+ *  args:
+ *      @fp : the stream to write to
+ *      @s  : the string to write
+ */
+void write_str(FILE *fp, char *s);
+
+/*
+ *  read_str
+ *      read a length-prefixed string from the given stream
+ *  args:
+ *      @fp : the stream to read from
+ *  return:
+ *      returns a newly allocated string, or NULL if the stream ended early
+ *      or the length is not sane
+ */
+char *read_str(FILE *fp);
+
+/*
+ *  write_sloc
+ *      write the members of a sloc counter to the given stream
+ *  args:
+ *      @fp     : the stream to write to
+ *      @counts : the counter to write
+ */
+void write_sloc(FILE *fp, sloc_t *counts);
+
+/*
+ *  read_sloc
+ *      read the members of a sloc counter from the given stream
+ *  args:
+ *      @fp     : the stream to read from
+ *      @counts : the location to store the counter
+ *  return:
+ *      returns 0 on success, or -1 if the stream ended early
+ */
+int read_sloc(FILE *fp, sloc_t *counts);
+
+/*
+ *  write_partial
+ *      write the raw per-language counts (and any per-file records) to the
+ *      given file in the versioned partial format, so the results of
+ *      several runs can be merged later. exits on a write error.
+ *  args:
+ *      @filename   : the file to write, or "-" for stdout
+ *      @counts     : the counted lines of code
+ */
+void write_partial(char *filename, sloc_t *counts);
+
+/*
+ *  write_partial_body
+ *      write the counts and per-file records of a partial file, without
+ *      its header, so they can be embedded in other files
+ *  args:
+ *      @fp     : the stream to write to
+ *      @counts : the counted lines of code
+ */
+void write_partial_body(FILE *fp, sloc_t *counts);
+
+/*
+ *  read_partial
+ *      read a partial file and add its counts to the given counters. if
+ *      per-file records are being kept, the records in the file are kept
+ *      as well. if the file holds a partial result, the merged result is
+ *      marked partial too. exits if the file cannot be read or is not a
+ *      partial file.
+ *  args:
+ *      @filename   : the file to read, or "-" for stdin
+ *      @counts     : the location to store the line counts
+ */
+void read_partial(char *filename, sloc_t *counts);
+
+/*
+ *  read_partial_body
+ *      read the counts and per-file records written by write_partial_body,
+ *      the same way read_partial does
+ *  args:
+ *      @fp         : the stream to read from
+ *      @filename   : the name of the file, for error messages
+ *      @counts     : the location to store the line counts
+ */
+void read_partial_body(FILE *fp, char *filename, sloc_t *counts);
+
+/*
+ *  bad_partial
+ *      print an error message about a corrupt partial file, then exit
+ *      unsuccessfully.
+ *  args:
+ *      @filename   : the name of the partial file
+ */
+void bad_partial(char *filename);
+
+/*
+ *  parse_num
+ *      parse a non-negative number from an argument. exits with an error
+ *      message if the argument is not a valid number.
+ *  args:
+ *      @s  : the string to parse
+ *  return:
+ *      returns the parsed number
+ */
+double parse_num(char *s);
+
+/*
+ *  get_time
+ *      get the time from a monotonic clock
+ *  return:
+ *      returns the time in seconds
+ */
+double get_time(void);
+
+/*
+ *  add_est_file
+ *      remember a file found while estimating, so that it can be sampled
+ *      once the whole tree has been walked
+ *  args:
+ *      @path   : the path of the file
+ *      @lang   : the language of the file
+ *      @size   : the size of the file in bytes
+ */
+void add_est_file(char *path, int lang, off_t size);
+
+/*
+ *  cmp_est_file
+ *      qsort comparison function, ordering files by language then size
+ *  args:
+ *      @a  : the first est_file_t
+ *      @b  : the second est_file_t
+ *  return:
+ *      returns <0, 0 or >0 if a sorts before, with, or after b
+ */
+int cmp_est_file(const void *a, const void *b);
+
+/*
+ *  est_sample
+ *      count the next unsampled file in a stratum and add it to the sums
+ *  args:
+ *      @e  : the language being sampled
+ *      @h  : the stratum to sample from
+ */
+void est_sample(est_lang_t *e, int h);
+
+/*
+ *  est_strata
+ *      set aside the largest files of a language in a stratum of their own
+ *      to be counted in full, then split the rest into strata holding equal
+ *      numbers of bytes and shuffle each stratum
+ *  args:
+ *      @e  : the language to split, with its files sorted by size
+ */
+void est_strata(est_lang_t *e);
+
+/*
+ *  est_bounds
+ *      extrapolate the counts of a language from its sample, using the
+ *      lines per byte of each stratum and the known sizes of its files,
+ *      along with the half-width of their confidence intervals. the
+ *      half-width is only 0 if every file was counted.
+ *  args:
+ *      @e      : the language to extrapolate
+ *      @est    : the location to store the estimates, by IDX_ member
+ *      @hw     : the location to store the half-widths, by IDX_ member
+ */
+void est_bounds(est_lang_t *e, double *est, double *hw);
+
+/*
+ *  est_done
+ *      check whether the code estimate of a language is within the error
+ *      bound, once all of its largest files and enough of each other
+ *      stratum have been counted
+ *  args:
+ *      @e      : the language to check
+ *      @err    : the relative error bound
+ *  return:
+ *      returns nonzero if no more files need to be sampled
+ */
+int est_done(est_lang_t *e, double err);
+
+/*
+ *  estimate_counts
+ *      sample the files found while walking the tree, stratified by size
+ *      within each language, until every language is within the error
+ *      bound or the time budget runs out. adds the extrapolated counts to
+ *      the given counters.
+ *  args:
+ *      @counts     : the location to store the line counts
+ *      @err        : the relative error bound, or 0 for none
+ *      @time_budget: the time budget in seconds, or 0 for none
+ *      @hw         : the location to store the confidence half-widths
+ *      @sampled    : the location to store the number of files sampled
+ */
+void estimate_counts(sloc_t *counts, double err, double time_budget,
+                     double hw[][NUM_MEMBERS], int *sampled);
+
+/*
+ *  print_estimate
+ *      prints the half-widths of the 95% confidence intervals of each
+ *      estimated count, in the same layout as print_sloc.
+ *  args:
+ *      counts      : the estimated lines of code
+ *      hw          : the confidence half-widths
+ *      sampled     : the number of files sampled for each language
+ *      print_tots  : whether or not to print the totals
+ */
+void print_estimate(sloc_t *counts, double hw[][NUM_MEMBERS], int *sampled,
+                    int print_tots);
+
+/*
+ *  dirent_visible
+ *      scandir filter that skips hidden files, like count_folder does
+ *  args:
+ *      @d  : the directory entry
+ *  return:
+ *      returns nonzero if the entry should be listed
+ */
+int dirent_visible(const struct dirent *d);
+
+/*
+ *  cmp_dirent
+ *      scandir comparison function, ordering entries bytewise by name
+ *  args:
+ *      @a  : the first entry
+ *      @b  : the second entry
+ *  return:
+ *      returns <0, 0 or >0 if a sorts before, with, or after b
+ */
+int cmp_dirent(const struct dirent **a, const struct dirent **b);
+
+/*
+ *  free_dir_list
+ *      frees a directory listing returned by scandir
+ *  args:
+ *      @list   : the listing to free
+ *      @n      : the number of entries in the listing
+ */
+void free_dir_list(struct dirent **list, int n);
+
+/*
+ *  diff_lines
+ *      compare the lines of code of two files or folders with the same
+ *      relative path. if only one of them exists, or they are different
+ *      kinds of file, all of its lines count as added or removed.
+ *  args:
+ *      @oldname    : the path in the old tree
+ *      @newname    : the path in the new tree
+ *      @added      : the location to store the added line counts
+ *      @removed    : the location to store the removed line counts
+ *      @changed    : the location to store the number of changed files
+ */
+void diff_lines(char *oldname, char *newname, sloc_t *added,
+                sloc_t *removed, int *changed);
+
+/*
+ *  diff_folder
+ *      compare every file in two directories, pairing the entries by name
+ *  args:
+ *      @olddir     : the directory in the old tree
+ *      @newdir     : the directory in the new tree
+ *      @added      : the location to store the added line counts
+ *      @removed    : the location to store the removed line counts
+ *      @changed    : the location to store the number of changed files
+ */
+void diff_folder(char *olddir, char *newdir, sloc_t *added,
+                 sloc_t *removed, int *changed);
+
+/*
+ *  diff_file
+ *      compare two versions of a source file. identical files are skipped
+ *      without being counted; otherwise the net change in each line count
+ *      of the file is added to the added or removed counters. this is not a
+ *      line-by-line diff, so rewritten lines that keep the counts the same
+ *      add nothing.
+ *  args:
+ *      @oldname    : the name of the old file
+ *      @so         : the stat of the old file
+ *      @newname    : the name of the new file
+ *      @sn         : the stat of the new file
+ *      @lang       : the language of the files
+ *      @added      : the location to store the added line counts
+ *      @removed    : the location to store the removed line counts
+ *      @changed    : the location to store the number of changed files
+ */
+void diff_file(char *oldname, struct stat *so, char *newname,
+               struct stat *sn, int lang, sloc_t *added, sloc_t *removed,
+               int *changed);
+
+/*
+ *  same_contents
+ *      check whether two files have the same contents
+ *  args:
+ *      @a  : the name of the first file
+ *      @b  : the name of the second file
+ *  return:
+ *      returns nonzero if both files could be read and are identical
+ */
+int same_contents(char *a, char *b);
+
+/*
+ *  print_diff
+ *      prints the net growth and shrinkage of the line counts of each
+ *      language in a neat table, like print_sloc. the files column counts
+ *      the files that were added, removed or changed.
+ *  args:
+ *      out         : the stream to print to
+ *      added       : the added lines of code
+ *      removed     : the removed lines of code
+ *      changed     : the number of changed files in each language
+ *      print_tots  : whether or not to print the totals
+ */
+void print_diff(FILE *out, sloc_t *added, sloc_t *removed, int *changed,
+                int print_tots);
+
+/*
+ *  parse_rate
+ *      parse a positive rate, in bytes, from an argument. the rate may end
+ *      with k, m or g to multiply it by a power of 1024. exits with an
+ *      error message if the argument is not a valid rate.
+ *  args:
+ *      @s  : the string to parse
+ *  return:
+ *      returns the parsed rate
+ */
+double parse_rate(char *s);
+
+/*
+ *  sleep_for
+ *      sleep for the given number of seconds, but never past the deadline,
+ *      and handle any signals that arrive meanwhile. returns early once
+ *      counting is stopped.
+ *  args:
+ *      @secs   : the time to sleep
+ */
+void sleep_for(double secs);
+
+/*
+ *  bucket_init
+ *      fill a token bucket whose rate is already set
+ *  args:
+ *      @b      : the bucket
+ *      @now    : the current time
+ *      @burst  : the least the bucket may hold
+ */
+void bucket_init(bucket_t *b, double now, double burst);
+
+/*
+ *  bucket_take
+ *      take tokens from a bucket, sleeping as long as needed to stay within
+ *      its rate
+ *  args:
+ *      @b  : the bucket
+ *      @n  : the number of tokens to take
+ */
+void bucket_take(bucket_t *b, double n);
+
+/*
+ *  budget_cpu
+ *      sleep as long as needed to keep the cpu time used within budget
+ */
+void budget_cpu(void);
+
+/*
+ *  budget_read
+ *      account for bytes read from a file, sleeping if over budget
+ *  args:
+ *      @n  : the number of bytes read
+ */
+void budget_read(size_t n);
+
+/*
+ *  budget_open
+ *      account for a file about to be opened, sleeping if over budget
+ */
+void budget_open(void);
+
+/*
+ *  drop_cache
+ *      tell the kernel the pages of a file that has been read are not
+ *      needed, so counting does not evict the rest of the page cache
+ *  args:
+ *      @fp : the stream of the file
+ */
+void drop_cache(FILE *fp);
+
+/*
+ *  set_idle
+ *      put the process in the idle cpu and io scheduling classes, where
+ *      they are supported. prints a warning if that fails.
+ */
+void set_idle(void);
+
+/*
+ *  budget_report
+ *      print the rates achieved while on a budget to stderr
+ */
+void budget_report(void);
+
+/*
+ *  on_signal
+ *      signal handler that records which signal arrived, to be handled the
+ *      next time poll_signals is called
+ *  args:
+ *      @sig    : the signal number
+ */
+void on_signal(int sig);
+
+/*
+ *  setup_signals
+ *      install the handlers for SIGINT, SIGUSR1 and SIGALRM, and start the
+ *      progress timer if progress or a deadline was asked for
+ */
+void setup_signals(void);
+
+/*
+ *  arm_timer
+ *      start the progress timer, first firing after the given delay and
+ *      then every PROGRESS_INTERVAL seconds
+ *  args:
+ *      @first  : the delay before the first tick, in seconds
+ */
+void arm_timer(double first);
+
+/*
+ *  poll_signals
+ *      handle any signals that have arrived: print progress or a snapshot
+ *      of the counts, and stop counting on an interrupt or at the deadline.
+ *      only called when sig_pending is set, so it costs nothing otherwise.
+ *  return:
+ *      returns nonzero if counting should stop
+ */
+int poll_signals(void);
+
+/*
+ *  print_progress
+ *      print a line of progress information to stderr
+ *  args:
+ *      @now    : the current time
+ */
+void print_progress(double now);
+
+/*
+ *  precount
+ *      count the files that count_lines would count in the given file or
+ *      folder, without reading them
+ *  args:
+ *      @filename   : the name of the file or folder
+ *  return:
+ *      returns the number of files found
+ */
+long precount(char *filename);
+
+/*
+ *  precount_folder
+ *      count the files that count_folder would count in a directory
+ *  args:
+ *      @dirname    : the name of the directory
+ *  return:
+ *      returns the number of files found
+ */
+long precount_folder(char *dirname);
+
+/*
+ *  args_hash
+ *      fingerprint the arguments that decide which files a walk counts, so
+ *      a checkpoint is only resumed by the same command in the same
+ *      working directory. exits with an error message if any of the
+ *      arguments reads from stdin.
+ *  args:
+ *      @argv   : the program arguments
+ *      @ops    : the indices of the files to count in argv
+ *      @numops : the number of files to count
+ *  return:
+ *      returns the fingerprint
+ */
+unsigned long args_hash(char **argv, int *ops, int numops);
+
+/*
+ *  finish_operand
+ *      record that an argument has been counted completely, unless counting
+ *      was stopped part way through it
+ *  args:
+ *      @next   : the index of the next argument to count
+ */
+void finish_operand(int next);
+
+/*
+ *  resume_cmp
+ *      compare a directory entry with the path a resumed walk continues
+ *      from. once the walk is past that path, resuming is over.
+ *  args:
+ *      @path   : the path of the entry
+ *      @idx    : the index of the entry's name in the path
+ *  return:
+ *      returns <0 if the entry was counted before the checkpoint, 0 if it
+ *      is on the resume path, or >0 if it still has to be counted
+ */
+int resume_cmp(char *path, int idx);
+
+/*
+ *  write_checkpoint
+ *      atomically replace the checkpoint file with the current counts and
+ *      the last file counted. prints a warning if that fails.
+ */
+void write_checkpoint(void);
+
+/*
+ *  read_checkpoint
+ *      load the counts saved in a checkpoint, and set up the walk to skip
+ *      everything counted before it. exits if the checkpoint is not valid
+ *      or was saved with different arguments.
+ *  args:
+ *      @filename   : the checkpoint file
+ *      @counts     : the location to store the line counts
+ */
+void read_checkpoint(char *filename, sloc_t *counts);
+
 /*
  *  print_sloc
  *      prints the total number of sloc counted in a neat table, sorted
  *      according to the number of lines of code.
  *  args:
+ *      out         : the stream to print to
  *      counts      : the counted lines of code
  *      print_tots  : whether or not to print the totals
  */
-void print_sloc(sloc_t *counts, int print_tots);
+void print_sloc(FILE *out, sloc_t *counts, int print_tots);
 
 /*
  *  set_max_lens
@@ -197,18 +933,20 @@ void free_sloc_list(sloc_list_t *lst);
  *  print_sloc_list
  *      print the sloc list using the given lengths for each member
  *  args:
+ *      @out    : the stream to print to
  *      @list   : the list to print
  *      @lens   : the lengths for each member
  */
-void print_sloc_list(sloc_list_t *list, int *lens);
+void print_sloc_list(FILE *out, sloc_list_t *list, int *lens);
 
 /*
  *  print_member
  *      print the member of the sloc list with the given length
  *  args:
- *      @s  : the string to print
- *      @n  : the total number of characters to print
+ *      @out    : the stream to print to
+ *      @s      : the string to print
+ *      @n      : the total number of characters to print
  */
-void print_member(char *s, int n);
+void print_member(FILE *out, char *s, int n);
 
 #endif /* _SLOC_H_ */